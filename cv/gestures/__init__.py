@@ -1,3 +1,3 @@
-from gestures.gesture_recognition import GestureRecognition, GestureBuffer
+from gestures.gesture_recognition import GestureRecognition, GestureBuffer, ClassificationCache
 # from gestures.tello_gesture_controller import TelloGestureController
 # from gestures.tello_keyboard_controller import TelloKeyboardController
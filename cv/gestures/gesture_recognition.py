@@ -1,5 +1,6 @@
 #!/usr/bin/env python
 # -*- coding: utf-8 -*-
+import os
 import csv
 import copy
 import itertools
@@ -8,22 +9,27 @@ from collections import deque
 
 import cv2 as cv
 import numpy as np
-import mediapipe as mp
 from motor import MotorSelection
 
 from utils import CvFpsCalc
-from model import KeyPointClassifier
-from model import PointHistoryClassifier
+
+MODEL_DIR = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), 'model')
 
 
 class GestureRecognition:
     def __init__(self, use_static_image_mode=False, min_detection_confidence=0.7, min_tracking_confidence=0.7,
-                 history_length=16):
+                 history_length=16, cache_epsilon=0.04, point_history_cache_epsilon=0.01,
+                 cache_refresh_frames=30):
         self.use_static_image_mode = use_static_image_mode
         self.min_detection_confidence = min_detection_confidence
         self.min_tracking_confidence = min_tracking_confidence
         self.history_length = history_length
 
+        # Classification results are reused while the hand stays (almost) still. Landmarks are
+        # normalized by hand size and the point history by image size, hence separate epsilons
+        self.keypoint_cache = ClassificationCache(cache_epsilon, cache_refresh_frames)
+        self.point_history_cache = ClassificationCache(point_history_cache_epsilon, cache_refresh_frames)
+
         # Load models
         self.hands, self.keypoint_classifier, self.keypoint_classifier_labels, \
         self.point_history_classifier, self.point_history_classifier_labels = self.load_model()
@@ -34,6 +40,11 @@ class GestureRecognition:
 
     def load_model(self):
         # Model load #############################################################
+        # Heavy runtimes are imported here so their start-up cost overlaps with opening the camera
+        import mediapipe as mp
+        from model import KeyPointClassifier
+        from model import PointHistoryClassifier
+
         mp_hands = mp.solutions.hands
         hands = mp_hands.Hands(
             static_image_mode=self.use_static_image_mode,
@@ -46,14 +57,14 @@ class GestureRecognition:
         point_history_classifier = PointHistoryClassifier()
 
         # Read labels ###########################################################
-        with open('model/keypoint_classifier/keypoint_classifier_label.csv',
+        with open(os.path.join(MODEL_DIR, 'keypoint_classifier/keypoint_classifier_label.csv'),
                   encoding='utf-8-sig') as f:
             keypoint_classifier_labels = csv.reader(f)
             keypoint_classifier_labels = [
                 row[0] for row in keypoint_classifier_labels
             ]
         with open(
-                'model/point_history_classifier/point_history_classifier_label.csv',
+                os.path.join(MODEL_DIR, 'point_history_classifier/point_history_classifier_label.csv'),
                 encoding='utf-8-sig') as f:
             point_history_classifier_labels = csv.reader(f)
             point_history_classifier_labels = [
@@ -63,6 +74,17 @@ class GestureRecognition:
         return hands, keypoint_classifier, keypoint_classifier_labels, \
                point_history_classifier, point_history_classifier_labels
 
+    def warmup(self, image):
+        # The first calls into mediapipe and the tflite interpreters are much slower than the
+        # following ones, pay that cost before the control loop starts. Mediapipe only runs its
+        # hand landmark model when a palm is detected, without a hand in the frame that model
+        # stays cold until the first real detection
+        image = cv.cvtColor(cv.flip(image, 1), cv.COLOR_BGR2RGB)
+        self.hands.process(image)
+
+        self.keypoint_classifier([0.0] * 42)
+        self.point_history_classifier([0.0] * (self.history_length * 2))
+
     def recognize(self, image, number=-1, mode=0):
 
         # TODO: Move constants to other place
@@ -101,7 +123,10 @@ class GestureRecognition:
                                   pre_processed_point_history_list)
 
                 # Hand sign classification
-                hand_sign_id = self.keypoint_classifier(pre_processed_landmark_list)
+                hand_sign_id = self.keypoint_cache.lookup(pre_processed_landmark_list)
+                if hand_sign_id is None:
+                    hand_sign_id = self.keypoint_classifier(pre_processed_landmark_list)
+                    self.keypoint_cache.store(pre_processed_landmark_list, hand_sign_id)
                 if hand_sign_id == 2:  # Point gesture
                     self.point_history.append(landmark_list[8])
                 else:
@@ -111,8 +136,11 @@ class GestureRecognition:
                 finger_gesture_id = 0
                 point_history_len = len(pre_processed_point_history_list)
                 if point_history_len == (self.history_length * 2):
-                    finger_gesture_id = self.point_history_classifier(
-                        pre_processed_point_history_list)
+                    finger_gesture_id = self.point_history_cache.lookup(pre_processed_point_history_list)
+                    if finger_gesture_id is None:
+                        finger_gesture_id = self.point_history_classifier(
+                            pre_processed_point_history_list)
+                        self.point_history_cache.store(pre_processed_point_history_list, finger_gesture_id)
 
                 # Calculates the gesture IDs in the latest detection
                 self.finger_gesture_history.append(finger_gesture_id)
@@ -134,6 +162,8 @@ class GestureRecognition:
                 gesture_id = hand_sign_id
         else:
             self.point_history.append([0, 0])
+            self.keypoint_cache.clear()
+            self.point_history_cache.clear()
 
         debug_image = self.draw_point_history(debug_image, self.point_history)
 
@@ -152,6 +182,10 @@ class GestureRecognition:
                    1.0, (0, 0, 0), 4, cv.LINE_AA)
         cv.putText(image, "FPS:" + str(fps), (10, 30), cv.FONT_HERSHEY_SIMPLEX,
                    1.0, (255, 255, 255), 2, cv.LINE_AA)
+        cv.putText(image, f"KP hit/miss: {self.keypoint_cache.hits}/{self.keypoint_cache.misses}", (10, 55),
+                   cv.FONT_HERSHEY_SIMPLEX, 0.6, (255, 255, 255), 1, cv.LINE_AA)
+        cv.putText(image, f"PH hit/miss: {self.point_history_cache.hits}/{self.point_history_cache.misses}", (10, 75),
+                   cv.FONT_HERSHEY_SIMPLEX, 0.6, (255, 255, 255), 1, cv.LINE_AA)
         cv.putText(image, lower_left_text, (10, 460), cv.FONT_HERSHEY_SIMPLEX,
                    1.0, (255, 255, 255), 2, cv.LINE_AA)
         
@@ -493,3 +527,38 @@ class GestureBuffer:
             return counter[0][0]
         else:
             return
+
+
+class ClassificationCache:
+    def __init__(self, epsilon=0.04, refresh_frames=30):
+        self.epsilon = epsilon
+        self.refresh_frames = refresh_frames
+        self.hits = 0
+        self.misses = 0
+        self._key = None
+        self._result = None
+        self._age = 0
+
+    def lookup(self, key):
+        # Reuse the last result while no coordinate moved more than epsilon (L-infinity
+        # distance), but force a fresh classification every refresh_frames frames
+        key = np.asarray(key, dtype=np.float32)
+        if self._key is not None and self._age + 1 < self.refresh_frames \
+                and key.shape == self._key.shape \
+                and np.max(np.abs(key - self._key)) <= self.epsilon:
+            self._age += 1
+            self.hits += 1
+            return self._result
+
+        self.misses += 1
+        return None
+
+    def store(self, key, result):
+        self._key = np.asarray(key, dtype=np.float32)
+        self._result = result
+        self._age = 0
+
+    def clear(self):
+        self._key = None
+        self._result = None
+        self._age = 0
@@ -1,8 +1,11 @@
 #!/usr/bin/env python
 
+from concurrent.futures import ThreadPoolExecutor
+
 import cv2 as cv
+import numpy as np
 from serial.serialutil import SerialException
-from utils import CvFpsCalc
+from utils import CvFpsCalc, StartupTimeline
 from gestures import *
 import configargparse
 import serial
@@ -27,24 +30,81 @@ def get_args():
     parser.add("--buffer_len",
                help="Length of gesture buffer",
                type=int)
+    parser.add("--cache_epsilon",
+               help="Max change of the hand-size normalized landmarks for reusing the previous hand sign",
+               type=float,
+               default=0.04)
+    parser.add("--point_history_cache_epsilon",
+               help="Max change of the image-size normalized point history for reusing the previous finger gesture",
+               type=float,
+               default=0.01)
+    parser.add("--cache_refresh_frames",
+               help="Frames after which a cached classification is refreshed",
+               type=int,
+               default=30)
 
     args = parser.parse_args()
 
     return args
 
 
+def open_camera(device, startup_timeline):
+    cap = cv.VideoCapture(device)
+    startup_timeline.mark("camera opened")
+    return cap
+
+
+def open_stm32(startup_timeline):
+    try:
+        stm32 = serial.Serial(MOTOR_SERIAL_PORT)
+        stm32.baudrate = 115200
+        stm32.write(b"init\n")
+        stm32.write(b"stepperstart\n")
+        stm32.write(b"dcstart\n")
+        stm32.write(b"adcinit\n")
+        startup_timeline.mark("serial port opened")
+        return stm32
+    except SerialException:
+        print("Error setting up serial com for STM32 board")
+        startup_timeline.mark("serial port unavailable")
+        return None
+
+
 def main():
     # init global vars
     global gesture_buffer
     global gesture_id
 
+    startup_timeline = StartupTimeline()
+
     args = get_args()
+    startup_timeline.mark("configuration read")
+
+    # Camera and serial port are opened in the background while the models load
+    with ThreadPoolExecutor(max_workers=2, thread_name_prefix="startup") as executor:
+        cap_future = executor.submit(open_camera, args.device, startup_timeline)
+        stm32_future = executor.submit(open_stm32, startup_timeline)
+
+        gesture_detector = GestureRecognition(args.use_static_image_mode,
+                                            args.min_detection_confidence,
+                                            args.min_tracking_confidence,
+                                            cache_epsilon=args.cache_epsilon,
+                                            point_history_cache_epsilon=args.point_history_cache_epsilon,
+                                            cache_refresh_frames=args.cache_refresh_frames)
+        startup_timeline.mark("models loaded")
+
+        # Warm up on a real frame so the input matches the camera's resolution
+        cap = cap_future.result()
+        success, image = cap.read()
+        if not success:
+            image = np.zeros((int(cap.get(cv.CAP_PROP_FRAME_HEIGHT)) or args.height,
+                              int(cap.get(cv.CAP_PROP_FRAME_WIDTH)) or args.width, 3), dtype=np.uint8)
+        gesture_detector.warmup(image)
+        startup_timeline.mark("models warmed up")
 
-    cap = cv.VideoCapture(args.device)
+        stm32 = stm32_future.result()
+        stm_available = stm32 is not None
 
-    gesture_detector = GestureRecognition(args.use_static_image_mode,
-                                        args.min_detection_confidence,
-                                        args.min_tracking_confidence)
     gesture_buffer = GestureBuffer(buffer_len=args.buffer_len)
 
     # FPS measurement
@@ -60,25 +120,14 @@ def main():
     # Debug text
     lower_left_text = ""
 
-    # Set up serial communication stuff
-    stm_available = False
-    try:
-        stm32 = serial.Serial(MOTOR_SERIAL_PORT)
-        stm32.baudrate = 115200
-        stm_available = True
-        stm32.write(b"init\n")
-        stm32.write(b"stepperstart\n")
-        stm32.write(b"dcstart\n")
-        stm32.write(b"adcinit\n")
-    except SerialException:
-        print("Error setting up serial com for STM32 board")
-
     # Default motor profile
     motor_profile = MotorProfile.SPEED
     motor_selection = MotorSelection.STEPPER_MOTOR
     dc_motor_direction = MotorDirection.CLOCKWISE
     stepper_motor_direction = MotorDirection.CLOCKWISE
 
+    first_frame = True
+
     while True:
         fps = cv_fps_calc.get()
 
@@ -147,6 +196,11 @@ def main():
         
         delay_counter += 1
 
+        if first_frame:
+            startup_timeline.mark("first frame processed")
+            startup_timeline.report()
+            first_frame = False
+
         if motor_profile == MotorProfile.SPEED:
             if motor_selection == MotorSelection.STEPPER_MOTOR:
                 lower_left_text = f"Speed: {int(stepper_speed_percent)}%"
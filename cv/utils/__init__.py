@@ -1 +1,2 @@
-from utils.cvfpscalc import CvFpsCalc
\ No newline at end of file
+from utils.cvfpscalc import CvFpsCalc
+from utils.startup_timeline import StartupTimeline
\ No newline at end of file
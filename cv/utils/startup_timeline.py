@@ -0,0 +1,24 @@
+import threading
+import time
+
+
+class StartupTimeline(object):
+    def __init__(self):
+        self._start_time = time.perf_counter()
+        self._events = []
+        self._lock = threading.Lock()
+
+    def mark(self, label):
+        # Safe to call from worker threads, events are printed in time order by report()
+        with self._lock:
+            self._events.append((time.perf_counter(), threading.current_thread().name, label))
+
+    def report(self):
+        with self._lock:
+            events = sorted(self._events)
+
+        last_time = self._start_time
+        for event_time, thread_name, label in events:
+            print(f"[startup] {(event_time - self._start_time) * 1000.0:8.1f} ms "
+                  f"(+{(event_time - last_time) * 1000.0:7.1f} ms) [{thread_name}] {label}")
+            last_time = event_time
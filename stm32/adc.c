@@ -0,0 +1,449 @@
+/*
+ *******************************************************************************
+ * File Name        :   adc.c
+ *
+ * Description      :   Motor current/voltage sensing using ADC 1, triggered by
+ *                      Timer 1 and transferred by DMA into a circular buffer
+ *
+ * Author           :   Himanshu Parihar
+ *
+ * Date             :   December 01, 2021
+ *******************************************************************************
+ */
+#include "adc.h"
+#include "main.h"
+#include "stm32f411xe.h"
+#include "stm32f4xx_hal.h"
+#include "stm32f4xx_hal_adc.h"
+#include "stm32f4xx_hal_dma.h"
+#include "stm32f4xx_hal_gpio.h"
+#include "stm32f4xx_hal_rcc.h"
+#include "stm32f4xx_hal_tim.h"
+#include "my_timer.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "sys/_stdint.h"
+
+// Samples per channel in one half of the DMA buffer, this is the CIC
+// decimation ratio and must be a power of two
+#define ADC_DECIMATION_RATIO 16
+#define ADC_DECIMATION_SHIFT 4
+#define ADC_DMA_BUFFER_LENGTH (2 * ADC_DECIMATION_RATIO * ADC_NUM_CHANNELS)
+
+// Number of decimated samples in the moving average
+#define ADC_AVERAGE_LENGTH 8
+#define ADC_AVERAGE_SHIFT 3
+
+_Static_assert((1 << ADC_DECIMATION_SHIFT) == ADC_DECIMATION_RATIO,
+               "ADC_DECIMATION_SHIFT does not match ADC_DECIMATION_RATIO");
+_Static_assert((1 << ADC_AVERAGE_SHIFT) == ADC_AVERAGE_LENGTH,
+               "ADC_AVERAGE_SHIFT does not match ADC_AVERAGE_LENGTH");
+
+#define ADC_VREF_MILLIVOLTS 3300
+#define ADC_FULL_SCALE 4095
+
+/* Decimation filter, one per channel */
+typedef struct myAdcFilterType {
+    uint16_t history[ADC_AVERAGE_LENGTH];
+    uint32_t sum;
+    uint8_t index;
+} myAdcFilter;
+
+extern TIM_HandleTypeDef htim1;
+
+ADC_HandleTypeDef hadc1;
+DMA_HandleTypeDef hdma_adc1;
+
+static uint16_t adcDmaBuffer[ADC_DMA_BUFFER_LENGTH];
+static myAdcFilter adcFilters[ADC_NUM_CHANNELS];
+static volatile uint16_t adcReadings[ADC_NUM_CHANNELS];
+
+static void myAdcDmaAbortCallback(DMA_HandleTypeDef *hdma);
+
+/*
+ * Function         :   myAdcInit
+ *
+ * Description      :   Initialize ADC 1 to convert the motor current and
+ *                      voltage channels on every Timer 1 compare 3 event and
+ *                      move the results into a circular DMA buffer
+ *
+ * Parameters       :
+ *      hadc        -   Handle to ADC 1
+ *      hdma        -   Handle to the DMA stream used by ADC 1
+ *
+ * Returns          :   HAL_StatusTypeDef indicating OK or Error
+ */
+HAL_StatusTypeDef myAdcInit(ADC_HandleTypeDef *hadc, DMA_HandleTypeDef *hdma)
+{
+    ADC_ChannelConfTypeDef sConfig = { 0 };
+    TIM_OC_InitTypeDef sConfigOC = { 0 };
+
+    // Conversions are triggered by Timer 1, which is set up by the init command
+    if (htim1.Instance != TIM1) {
+        printf("Run init first\n");
+        return HAL_ERROR;
+    }
+
+    // Enable clocks
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    // DMA
+    hdma->Instance = DMA2_Stream0;
+    hdma->Init.Channel = DMA_CHANNEL_0;
+    hdma->Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma->Init.Mode = DMA_CIRCULAR;
+    hdma->Init.Priority = DMA_PRIORITY_HIGH;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(hdma) != HAL_OK) {
+        printf("Error initializing DMA for ADC 1\n");
+        return HAL_ERROR;
+    }
+    __HAL_LINKDMA(hadc, DMA_Handle, *hdma);
+
+    // ADC, one scan of all channels on each trigger
+    hadc->Instance = ADC1;
+    hadc->Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    hadc->Init.Resolution = ADC_RESOLUTION_12B;
+    hadc->Init.ScanConvMode = ENABLE;
+    hadc->Init.ContinuousConvMode = DISABLE;
+    hadc->Init.DiscontinuousConvMode = DISABLE;
+    hadc->Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    hadc->Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T1_CC3;
+    hadc->Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    hadc->Init.NbrOfConversion = ADC_NUM_CHANNELS;
+    hadc->Init.DMAContinuousRequests = ENABLE;
+    hadc->Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    if (HAL_ADC_Init(hadc) != HAL_OK) {
+        printf("Error initializing ADC 1\n");
+        return HAL_ERROR;
+    }
+
+    // Motor current
+    sConfig.Channel = ADC_CHANNEL_0;
+    sConfig.Rank = ADC_MOTOR_CURRENT + 1;
+    sConfig.SamplingTime = ADC_SAMPLETIME_84CYCLES;
+    if (HAL_ADC_ConfigChannel(hadc, &sConfig) != HAL_OK) {
+        printf("Error initializing ADC 1\n");
+        return HAL_ERROR;
+    }
+
+    // Motor voltage
+    sConfig.Channel = ADC_CHANNEL_1;
+    sConfig.Rank = ADC_MOTOR_VOLTAGE + 1;
+    if (HAL_ADC_ConfigChannel(hadc, &sConfig) != HAL_OK) {
+        printf("Error initializing ADC 1\n");
+        return HAL_ERROR;
+    }
+
+    // Timer 1 channel 3 is internal only and acts as the ADC trigger, the F411
+    // ADC cannot be triggered by the Timer 1 TRGO. Its compare value follows
+    // the DC motor duty cycle, see changeTimer1AdcTrigger
+    sConfigOC.OCMode = TIM_OCMODE_PWM1;
+    sConfigOC.Pulse = 0;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+    sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    if (HAL_TIM_PWM_ConfigChannel(&htim1, &sConfigOC, TIM_CHANNEL_3) != HAL_OK) {
+        printf("Error initializing Timer 1 for ADC 1\n");
+        return HAL_ERROR;
+    }
+    changeTimer1AdcTrigger(&htim1);
+
+    /* DMA and ADC overrun interrupt Init */
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    HAL_NVIC_SetPriority(ADC_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+
+    GPIO_InitTypeDef GPIO_InitStruct = { 0 };
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    /**ADC1 GPIO Configuration
+    PA0     ------> ADC1_IN0
+    PA1     ------> ADC1_IN1
+    */
+    GPIO_InitStruct.Pin = GPIO_PIN_0|GPIO_PIN_1;
+    GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    return HAL_OK;
+}
+
+/*
+ * Function         :   myAdcStart
+ *
+ * Description      :   Start the circular DMA transfer and the Timer 1 trigger
+ *
+ * Parameters       :
+ *      hadc        -   Handle to ADC 1
+ *
+ * Returns          :   void
+ */
+void myAdcStart(ADC_HandleTypeDef *hadc)
+{
+    for (int channel = 0; channel < ADC_NUM_CHANNELS; channel++) {
+        adcFilters[channel] = (myAdcFilter) { 0 };
+        adcReadings[channel] = 0;
+    }
+
+    if (HAL_ADC_Start_DMA(hadc, (uint32_t *) adcDmaBuffer, ADC_DMA_BUFFER_LENGTH) != HAL_OK) {
+        printf("Error starting ADC 1\n");
+        return;
+    }
+
+    // Also starts the Timer 1 counter if the motors have not been started yet
+    if (HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_3) != HAL_OK) {
+        printf("Error starting Timer 1 for ADC 1\n");
+    }
+}
+
+/*
+ * Function         :   myAdcGetReading
+ *
+ * Description      :   Get the latest averaged reading of a channel
+ *
+ * Parameters       :
+ *      channel     -   Channel to read
+ *
+ * Returns          :   uint16_t reading in ADC counts
+ */
+uint16_t myAdcGetReading(myAdcChannel channel)
+{
+    if (channel >= ADC_NUM_CHANNELS) {
+        return 0;
+    }
+
+    return adcReadings[channel];
+}
+
+/*
+ * Function         :   myAdcGetMillivolts
+ *
+ * Description      :   Get the latest averaged reading of a channel converted
+ *                      to millivolts at the ADC pin
+ *
+ * Parameters       :
+ *      channel     -   Channel to read
+ *
+ * Returns          :   uint32_t reading in millivolts
+ */
+uint32_t myAdcGetMillivolts(myAdcChannel channel)
+{
+    return ((uint32_t) myAdcGetReading(channel) * ADC_VREF_MILLIVOLTS) / ADC_FULL_SCALE;
+}
+
+/*
+ * Function         :   myAdcDecimate
+ *
+ * Description      :   Run one half of the DMA buffer through a first order
+ *                      CIC decimator followed by a moving average
+ *
+ * Parameters       :
+ *      samples     -   Start of the half buffer, interleaved by channel
+ *
+ * Returns          :   void
+ */
+static void myAdcDecimate(const uint16_t *samples)
+{
+    for (int channel = 0; channel < ADC_NUM_CHANNELS; channel++) {
+        myAdcFilter *filter = &adcFilters[channel];
+
+        // Integrate and dump
+        uint32_t integrator = 0;
+        for (int i = 0; i < ADC_DECIMATION_RATIO; i++) {
+            integrator += samples[i * ADC_NUM_CHANNELS + channel];
+        }
+        uint16_t decimated = integrator >> ADC_DECIMATION_SHIFT;
+
+        // Running sum over the last decimated samples
+        filter->sum -= filter->history[filter->index];
+        filter->sum += decimated;
+        filter->history[filter->index] = decimated;
+        filter->index = (filter->index + 1) & (ADC_AVERAGE_LENGTH - 1);
+
+        adcReadings[channel] = filter->sum >> ADC_AVERAGE_SHIFT;
+    }
+}
+
+/*
+ * Function         :   HAL_ADC_ConvHalfCpltCallback
+ *
+ * Description      :   This function gets called when the DMA has filled the
+ *                      first half of the buffer
+ *
+ * Parameters       :
+ *      hadc        -   Handle to the ADC for which the interrupt is generated
+ *
+ * Returns          :   void
+ */
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc == &hadc1) {
+        myAdcDecimate(&adcDmaBuffer[0]);
+
+        // The DC motor duty cycle and the stepper period are changed by other
+        // modules, follow them here so the next samples stay mid on-time
+        changeTimer1AdcTrigger(&htim1);
+    }
+}
+
+/*
+ * Function         :   HAL_ADC_ConvCpltCallback
+ *
+ * Description      :   This function gets called when the DMA has filled the
+ *                      second half of the buffer
+ *
+ * Parameters       :
+ *      hadc        -   Handle to the ADC for which the interrupt is generated
+ *
+ * Returns          :   void
+ */
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc == &hadc1) {
+        myAdcDecimate(&adcDmaBuffer[ADC_DMA_BUFFER_LENGTH / 2]);
+        changeTimer1AdcTrigger(&htim1);
+    }
+}
+
+/*
+ * Function         :   HAL_ADC_ErrorCallback
+ *
+ * Description      :   This function gets called on an ADC overrun or DMA
+ *                      error, sampling is restarted
+ *
+ * Parameters       :
+ *      hadc        -   Handle to the ADC for which the interrupt is generated
+ *
+ * Returns          :   void
+ */
+void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc != &hadc1) {
+        return;
+    }
+
+    // HAL_ADC_Stop_DMA waits on HAL_GetTick(), which may never advance inside
+    // this interrupt. Abort the stream without waiting and restart once it has
+    // stopped, a DMA transfer error has already stopped it
+    CLEAR_BIT(hadc->Instance->CR2, ADC_CR2_DMA);
+    hadc->DMA_Handle->XferAbortCallback = myAdcDmaAbortCallback;
+    if (HAL_DMA_Abort_IT(hadc->DMA_Handle) != HAL_OK) {
+        HAL_ADC_Start_DMA(hadc, (uint32_t *) adcDmaBuffer, ADC_DMA_BUFFER_LENGTH);
+    }
+}
+
+/*
+ * Function         :   myAdcDmaAbortCallback
+ *
+ * Description      :   This function gets called once the DMA stream aborted
+ *                      by HAL_ADC_ErrorCallback has stopped, sampling is
+ *                      restarted
+ *
+ * Parameters       :
+ *      hdma        -   Handle to the DMA stream for which the interrupt is
+ *                      generated
+ *
+ * Returns          :   void
+ */
+static void myAdcDmaAbortCallback(DMA_HandleTypeDef *hdma)
+{
+    HAL_ADC_Start_DMA(&hadc1, (uint32_t *) adcDmaBuffer, ADC_DMA_BUFFER_LENGTH);
+}
+
+/*
+ * Function         :   DMA2_Stream0_IRQHandler
+ *
+ * Description      :   This function gets called when an interrupt occurs on
+ *                      DMA 2 stream 0
+ *
+ * Parameters       :   void
+ *
+ * Returns          :   void
+ */
+void DMA2_Stream0_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_adc1);
+}
+
+/*
+ * Function         :   ADC_IRQHandler
+ *
+ * Description      :   This function gets called when an interrupt occurs on
+ *                      ADC 1
+ *
+ * Parameters       :   void
+ *
+ * Returns          :   void
+ */
+void ADC_IRQHandler(void)
+{
+    HAL_ADC_IRQHandler(&hadc1);
+}
+
+/*
+ * Function         :   CmdAdcInit
+ *
+ * Description      :   Initialize and start motor current/voltage sampling
+ *
+ * Parameters       :
+ *      action      -   Integer indicating action type
+ *
+ * Returns          :   ParserReturnVal_t indicating OK or Failure
+ */
+ParserReturnVal_t CmdAdcInit(int action)
+{
+    if (action == CMD_SHORT_HELP) {
+        return CmdReturnOk;
+    }
+    if (action == CMD_LONG_HELP) {
+        printf("Sample motor current and voltage with ADC 1 in lock-step with Timer 1\n");
+        return CmdReturnOk;
+    }
+
+    if (myAdcInit(&hadc1, &hdma_adc1) != HAL_OK) {
+        return CmdReturnBadParameter1;
+    }
+    myAdcStart(&hadc1);
+
+    return CmdReturnOk;
+}
+
+/*
+ * Function         :   CmdAdcRead
+ *
+ * Description      :   Print the averaged motor current and voltage readings
+ *
+ * Parameters       :
+ *      action      -   Integer indicating action type
+ *
+ * Returns          :   ParserReturnVal_t indicating OK or Failure
+ */
+ParserReturnVal_t CmdAdcRead(int action)
+{
+    if (action == CMD_SHORT_HELP) {
+        return CmdReturnOk;
+    }
+    if (action == CMD_LONG_HELP) {
+        printf("Print averaged motor current and voltage in millivolts\n");
+        return CmdReturnOk;
+    }
+
+    printf("current: %" PRIu32 " mV, voltage: %" PRIu32 " mV\n",
+           myAdcGetMillivolts(ADC_MOTOR_CURRENT),
+           myAdcGetMillivolts(ADC_MOTOR_VOLTAGE));
+
+    return CmdReturnOk;
+}
+
+ADD_CMD("adcinit", CmdAdcInit, "Start motor current/voltage sampling")
+ADD_CMD("adcread", CmdAdcRead, "Print motor current/voltage")
@@ -0,0 +1,36 @@
+/*
+ *******************************************************************************
+ * File Name        :   adc.h
+ *
+ * Description      :   Motor current/voltage sensing API specification
+ *
+ * Author           :   Himanshu Parihar
+ *
+ * Date             :   December 01, 2021
+ *******************************************************************************
+ */
+#ifndef __ADC_H__
+#define __ADC_H__
+
+#include "stm32f4xx_hal.h"
+#include "common.h"
+
+typedef enum {
+    ADC_MOTOR_CURRENT,
+    ADC_MOTOR_VOLTAGE,
+    ADC_NUM_CHANNELS
+} myAdcChannel;
+
+/* Init function */
+HAL_StatusTypeDef myAdcInit(ADC_HandleTypeDef *hadc, DMA_HandleTypeDef *hdma);
+
+/* Function to start sampling in lock-step with Timer 1 */
+void myAdcStart(ADC_HandleTypeDef *hadc);
+
+/* Function to get the latest averaged reading of a channel in ADC counts */
+uint16_t myAdcGetReading(myAdcChannel channel);
+
+/* Function to get the latest averaged reading of a channel in millivolts */
+uint32_t myAdcGetMillivolts(myAdcChannel channel);
+
+#endif
@@ -314,6 +314,10 @@ void changeTimer1CaptureCompare(TIM_HandleTypeDef *htim, uint16_t timChannel, ui
     }
 
     __HAL_TIM_SET_COMPARE(htim, timChannel, value);
+
+    if (timChannel == TIM_CHANNEL_1) {
+        changeTimer1AdcTrigger(htim);
+    }
 }
 
 /*
@@ -334,6 +338,40 @@ void changeTimer1Period(TIM_HandleTypeDef *htim, uint16_t period)
         return;
     }
     __HAL_TIM_SET_AUTORELOAD(htim, period);
+    changeTimer1AdcTrigger(htim);
+}
+
+/*
+ * Function         :   changeTimer1AdcTrigger
+ *
+ * Description      :   Move the ADC trigger on channel 3 to the middle of the
+ *                      DC motor on-time, away from the switching edges at the
+ *                      start and end of the pulse where the current rings
+ *
+ * Parameters       :
+ *      htim        -   Handle to timer 1
+ *
+ * Returns          :   void
+ */
+void changeTimer1AdcTrigger(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance != TIM1) {
+        return;
+    }
+
+    uint32_t onTime = __HAL_TIM_GET_COMPARE(htim, TIM_CHANNEL_1);
+    uint32_t period = __HAL_TIM_GET_AUTORELOAD(htim);
+    if (onTime > period) {
+        onTime = period;
+    }
+
+    // A compare value of 0 never produces a trigger, keep sampling at 0% duty
+    uint32_t trigger = onTime / 2;
+    if (trigger == 0) {
+        trigger = 1;
+    }
+
+    __HAL_TIM_SET_COMPARE(htim, TIM_CHANNEL_3, trigger);
 }
 
 /*
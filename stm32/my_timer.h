@@ -45,6 +45,14 @@ void stopTimerNonBlockingDelay(TIM_HandleTypeDef *htim,
 
 void myTimer1Init(TIM_HandleTypeDef *htim, uint16_t prescaler, uint16_t period);
 
+/* Function to change counter period */
+void changeTimer1Period(TIM_HandleTypeDef *htim, uint16_t period);
+
+void changeTimer1CaptureCompare(TIM_HandleTypeDef *htim, uint16_t timChannel, uint16_t value);
+
+/* Function to place the ADC trigger in the middle of the DC motor on-time */
+void changeTimer1AdcTrigger(TIM_HandleTypeDef *htim);
+
 void myTimer3Init(TIM_HandleTypeDef *htim);
 
 #endif